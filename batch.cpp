@@ -0,0 +1,76 @@
+#include "batch.h"
+#include "calc.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+using std::size_t;
+using json = nlohmann::json;
+
+// Only the fields read by calculate() take part in the comparison.
+// The humidity that is not set is ignored, so stale defaults
+// do not split otherwise identical inputs.
+static std::tuple<double, const std::string&, bool, double>
+input_key(const input_data_t& in) {
+    return std::tuple<double, const std::string&, bool, double>(
+        in.air_temp, in.air_uom, in.is_dp_set,
+        in.is_dp_set ? in.dew_temp : in.relative_humidity);
+}
+
+batch_result_t calculate_batch (std::vector<response_t> batch,
+                                batch_stats_t* stats) {
+    batch_result_t out;
+    out.row.resize(batch.size());
+
+    // indices of the valid rows, ordered by input
+    std::vector<size_t> order;
+    order.reserve(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (batch[i].valid) {
+            order.push_back(i);
+        } else {
+            out.row[i] = out.responses.size();
+            out.responses.push_back(std::move(batch[i]));
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return input_key(batch[a].input) < input_key(batch[b].input);
+    });
+
+    size_t unique = 0;
+    for (size_t first = 0; first < order.size(); ) {
+        // calculate the first row of each run of equal inputs...
+        const auto& key = batch[order[first]].input;
+        auto index = out.responses.size();
+        ++unique;
+
+        // ...and point the rest of the run at its result
+        size_t last = first;
+        for (; last < order.size()
+               && input_key(batch[order[last]].input) == input_key(key); ++last) {
+            out.row[order[last]] = index;
+        }
+        out.responses.push_back(calculate(batch[order[first]]));
+        first = last;
+    }
+
+    if (stats != nullptr) {
+        stats->rows = batch.size();
+        stats->valid = order.size();
+        stats->unique = unique;
+    }
+    return out;
+}
+
+json make_json_stats(const batch_stats_t& stats) {
+    return {{"rows", stats.rows},
+            {"valid", stats.valid},
+            {"unique", stats.unique},
+            {"dedup_ratio", stats.dedup_ratio()}};
+}
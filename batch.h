@@ -0,0 +1,45 @@
+#pragma once
+
+#include "calc.h"
+
+#include <cstddef>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+// Counters gathered while calculating a batch of responses
+struct batch_stats_t {
+    std::size_t rows = 0;    // responses in the batch
+    std::size_t valid = 0;   // responses that passed validation
+    std::size_t unique = 0;  // distinct valid inputs actually calculated
+
+    // valid rows per calculation; 1.0 means no duplicates were found
+    double dedup_ratio() const {
+        return unique == 0 ? 1.0 : double(valid) / double(unique);
+    }
+};
+
+// The responses to a batch. Rows with the same input share
+// a single response, so it is built and serialized only once.
+struct batch_result_t {
+    // one response per distinct valid input and per invalid row
+    std::vector<response_t> responses;
+    // for each row of the batch, the index of its response
+    std::vector<std::size_t> row;
+
+    std::size_t size() const { return row.size(); }
+    const response_t& operator[](std::size_t i) const { return responses[row[i]]; }
+};
+
+// Calculate a batch of validated responses.
+//
+// Valid responses are sorted by their inputs so that each distinct
+// (air temp, uom, rh or dewpoint) tuple is passed through calculate()
+// exactly once, and every row with that input points at the result.
+// Invalid responses are passed through unchanged. The batch is taken
+// by value so callers can move it in instead of copying every row.
+batch_result_t calculate_batch (std::vector<response_t> batch,
+                                batch_stats_t* stats = nullptr);
+
+// build a json object reporting the batch counters
+nlohmann::json make_json_stats(const batch_stats_t& stats);
@@ -99,6 +99,37 @@ response_t validate(const kvp& query_params)
     return response;
 }
 
+InputError check_input (const input_data_t& input) {
+    if (input.air_uom != "F" && input.air_uom != "C") {
+	return InputError::unknown_uom;
+    }
+    if (input.is_rh_set && input.is_dp_set) {
+	return InputError::both_rh_dp;
+    }
+    auto temp = input.air_temp;
+    auto min_t = input.min_temp;
+    auto max_t = input.max_temp;
+    if (input.air_uom == "C") {
+	min_t = cvt_f_c(min_t);
+	max_t = cvt_f_c(max_t);
+    }
+    if (input.is_rh_set) {
+	if (!(input.relative_humidity >= 40.0 && input.relative_humidity <= 100)) {
+	    return InputError::rh_range;
+	}
+    } else if (input.is_dp_set) {
+	if (!is_temp_valid(input.dew_temp, min_t, temp)) {
+	    return InputError::dewpoint_range;
+	}
+    } else {
+	return InputError::missing_rh_dp;
+    }
+    if (!is_temp_valid(temp, min_t, max_t)) {
+	return InputError::air_temp_range;
+    }
+    return InputError::none;
+}
+
 bool key_provided(const std::string& quantity, const kvp& query_params) {
     auto it = query_params.find(quantity);
     return it != query_params.end();
@@ -232,24 +263,26 @@ bool neither_rh_dp_set (const response_t& r) {
 
 
 
-response_t calculate (const response_t& response) {
-    auto r = response;
-    auto air_temp_F = r.input.air_temp;
-    auto air_temp_C = r.input.air_temp;
-    auto dewpoint_C = r.input.dew_temp;
-    if (r.input.air_uom == "F") {
-	air_temp_C = cvt_f_c(r.input.air_temp);
-	dewpoint_C = cvt_f_c(r.input.dew_temp);
+double compute_heat_index (input_data_t& input) {
+    auto air_temp_F = input.air_temp;
+    auto air_temp_C = input.air_temp;
+    auto dewpoint_C = input.dew_temp;
+    if (input.air_uom == "F") {
+	air_temp_C = cvt_f_c(input.air_temp);
+	dewpoint_C = cvt_f_c(input.dew_temp);
     } else {
-	air_temp_F = cvt_c_f(r.input.air_temp);
+	air_temp_F = cvt_c_f(input.air_temp);
     }
-    if (r.input.is_dp_set) {
-	r.input.relative_humidity = calculate_relative_humidity(air_temp_C, dewpoint_C);
+    if (input.is_dp_set) {
+	input.relative_humidity = calculate_relative_humidity(air_temp_C, dewpoint_C);
     }
-    auto heat_index = calculate_heat_index(air_temp_F, r.input.relative_humidity);
+    return calculate_heat_index(air_temp_F, input.relative_humidity);
+}
+
+response_t calculate (const response_t& response) {
+    auto r = response;
+    auto heat_index = compute_heat_index(r.input);
     r.doc["data"]["heat_index"] = make_json_pair("deg F", heat_index);
 
     return r;
 }
-
-
@@ -51,6 +51,10 @@ struct response_t {
 // return the response structure
 response_t calculate (const response_t& response);
 
+// Calculate the heat index (deg F) for a validated input,
+// filling in the relative humidity first if a dewpoint was given.
+double compute_heat_index (input_data_t& input);
+
 // validate the query string read in by the program
 using kvp = std::map<std::string, std::string>;
 
@@ -59,6 +63,22 @@ using kvp = std::map<std::string, std::string>;
 // Validations
 response_t validate (const kvp& query_params);
 
+// The rule an input broke. When an input breaks several rules,
+// validate() reports the last one listed here: the values run from
+// lowest to highest precedence, and check_input() relies on that order.
+enum class InputError {
+    none = 0,
+    air_temp_range,
+    missing_rh_dp,
+    rh_range,
+    dewpoint_range,
+    both_rh_dp,
+    unknown_uom
+};
+
+// Apply the validate() rules to already parsed numeric inputs
+InputError check_input (const input_data_t& input);
+
 response_t read_air_temp (const kvp&, const response_t&);
 response_t read_air_temp_uom (const kvp&, const response_t&);
 response_t read_dewpoint (const kvp&, const response_t&);
@@ -0,0 +1,184 @@
+#include "columns.h"
+#include "calc.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using std::size_t;
+using std::uint8_t;
+using std::uint64_t;
+
+// rows validated together; their scratch masks live on the stack
+constexpr size_t block_rows = 256;
+
+// m ? a : b for a 0/1 mask. Written as arithmetic, since GCC will
+// not if-convert a floating point select and the loop would branch.
+// Only for finite a and b: 0 * NaN is still NaN.
+static inline double blend(double m, double a, double b) {
+    return m * a + (1.0 - m) * b;
+}
+
+// m ? a : b for a 0/1 mask, selecting on the bit patterns so that
+// a NaN or inf in the operand not chosen never reaches the result.
+static inline double select_bits(uint64_t m, double a, double b) {
+    uint64_t a_bits, b_bits;
+    std::memcpy(&a_bits, &a, sizeof a_bits);
+    std::memcpy(&b_bits, &b, sizeof b_bits);
+    uint64_t mask = -m;
+    uint64_t bits = (a_bits & mask) | (b_bits & ~mask);
+    double r;
+    std::memcpy(&r, &bits, sizeof r);
+    return r;
+}
+
+// 1 unless lo < x < hi (so also for NaN), else 0. Built from the
+// smaller distance to either limit, which compiles to a min
+// instruction where comparing against both limits would branch.
+static inline double outside(double x, double lo, double hi) {
+    auto above = x - lo;
+    auto below = hi - x;
+    auto gap = above < below ? above : below;
+    return double(gap <= 0) + double(gap != gap);
+}
+
+void validate_columns(size_t n,
+                      const double* air_temp,
+                      const double* dew_temp,
+                      const double* relative_humidity,
+                      const char* air_uom,
+                      const uint8_t* is_rh_set,
+                      const uint8_t* is_dp_set,
+                      uint8_t* error,
+                      uint64_t* valid) {
+    const input_data_t limits;
+    const double min_f = limits.min_temp;
+    const double max_f = limits.max_temp;
+    const double min_c = cvt_f_c(limits.min_temp);
+    const double max_c = cvt_f_c(limits.max_temp);
+
+    double celsius[block_rows];
+    double uom_ok[block_rows];
+    double rh_set[block_rows];
+    double dp_set[block_rows];
+    double code[block_rows];
+
+    for (size_t first = 0; first < n; first += block_rows) {
+        size_t rows = n - first < block_rows ? n - first : block_rows;
+        const char* uom = air_uom + first;
+        const uint8_t* rh_flag = is_rh_set + first;
+        const uint8_t* dp_flag = is_dp_set + first;
+        const double* t = air_temp + first;
+        const double* d = dew_temp + first;
+        const double* rh = relative_humidity + first;
+
+        // Widen the byte columns to 0/1 doubles, so that the rule
+        // pass works on a single element type and vectorizes.
+        for (size_t i = 0; i < rows; ++i) {
+            int c = uom[i] == 'C';
+            int f = uom[i] == 'F';
+            celsius[i] = c;
+            uom_ok[i] = c | f;
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            int r = rh_flag[i] != 0;
+            int p = dp_flag[i] != 0;
+            rh_set[i] = r;
+            dp_set[i] = p;
+        }
+
+        // Each rule is a 0/1 mask, and the error code is blended from
+        // the lowest precedence up, as in check_input().
+        for (size_t i = 0; i < rows; ++i) {
+            auto min_t = blend(celsius[i], min_c, min_f);
+            auto max_t = blend(celsius[i], max_c, max_f);
+            auto air_bad = outside(t[i], min_t, max_t);
+            auto rh_out = double(rh[i] < 40.0) + double(rh[i] > 100) + double(rh[i] != rh[i]);
+            auto dp_out = outside(d[i], min_t, t[i]);
+
+            auto neither = (1.0 - rh_set[i]) * (1.0 - dp_set[i]);
+            auto rh_bad = rh_set[i] * rh_out;
+            auto dp_bad = (1.0 - rh_set[i]) * dp_set[i] * dp_out;
+            auto both = rh_set[i] * dp_set[i];
+
+            auto k = blend(air_bad, double(InputError::air_temp_range), double(InputError::none));
+            k = blend(neither, double(InputError::missing_rh_dp), k);
+            k = blend(rh_bad, double(InputError::rh_range), k);
+            k = blend(dp_bad, double(InputError::dewpoint_range), k);
+            k = blend(both, double(InputError::both_rh_dp), k);
+            code[i] = blend(uom_ok[i], k, double(InputError::unknown_uom));
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            error[first + i] = uint8_t(code[i]);
+        }
+    }
+
+    // pack the error codes into the validity bitmap
+    size_t full = n / 64;
+    for (size_t w = 0; w < full; ++w) {
+        uint64_t word = 0;
+        for (size_t b = 0; b < 64; ++b) {
+            word |= uint64_t(error[w * 64 + b] == 0) << b;
+        }
+        valid[w] = word;
+    }
+    if (n % 64 != 0) {
+        uint64_t word = 0;
+        for (size_t b = 0; b < n % 64; ++b) {
+            word |= uint64_t(error[full * 64 + b] == 0) << b;
+        }
+        valid[full] = word;
+    }
+}
+
+void heat_index_kernel(size_t n,
+                       const double* air_temp,
+                       const double* dew_temp,
+                       const char* air_uom,
+                       const uint8_t* is_dp_set,
+                       double* relative_humidity,
+                       double* heat_index) {
+    // humidity from the dewpoint, calculated for every row and kept
+    // only where a dewpoint was given
+    // The unused humidity column is often left as NaN, so the
+    // selects work on bit patterns rather than with blend().
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t c = air_uom[i] == 'C';
+        uint64_t dp = is_dp_set[i] != 0;
+        auto air_temp_C = select_bits(c, air_temp[i], cvt_f_c(air_temp[i]));
+        auto dewpoint_C = select_bits(c, dew_temp[i], cvt_f_c(dew_temp[i]));
+        auto rh_dp = calculate_relative_humidity(air_temp_C, dewpoint_C);
+        relative_humidity[i] = select_bits(dp, rh_dp, relative_humidity[i]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t c = air_uom[i] == 'C';
+        auto air_temp_F = select_bits(c, cvt_c_f(air_temp[i]), air_temp[i]);
+        heat_index[i] = calculate_heat_index(air_temp_F, relative_humidity[i]);
+    }
+}
+
+void calculate_columns(size_t n,
+                       const double* air_temp,
+                       const double* dew_temp,
+                       double* relative_humidity,
+                       const char* air_uom,
+                       const uint8_t* is_rh_set,
+                       const uint8_t* is_dp_set,
+                       uint8_t* error,
+                       uint64_t* valid,
+                       double* heat_index) {
+    validate_columns(n, air_temp, dew_temp, relative_humidity,
+                     air_uom, is_rh_set, is_dp_set, error, valid);
+    heat_index_kernel(n, air_temp, dew_temp, air_uom, is_dp_set,
+                      relative_humidity, heat_index);
+
+    // Turn the heat index of invalid rows into NaN by setting the
+    // exponent and quiet bit, as a select on a double would branch.
+    const uint64_t quiet_nan = 0x7ff8000000000000ULL;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t bits;
+        std::memcpy(&bits, &heat_index[i], sizeof bits);
+        bits |= -uint64_t(error[i] != 0) & quiet_nan;
+        std::memcpy(&heat_index[i], &bits, sizeof bits);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Validation and calculation of inputs stored by column.
+//
+// Row i of a batch is described by element i of each array. The
+// rules are those of check_input(), evaluated for every row as
+// mask operations, so invalid rows cost the same as valid ones
+// and never cut the loop short. The loops have no data dependent
+// branches at -O2. At -O3 the rule and heat index passes vectorize,
+// except the dewpoint pass of heat_index_kernel(), whose exp call
+// needs a vector exp (e.g. -Ofast).
+
+// words needed for a validity bitmap of n rows
+constexpr std::size_t bitmap_words(std::size_t n) { return (n + 63) / 64; }
+
+// test the validity bit of a row
+inline bool row_valid(const std::uint64_t* valid, std::size_t row) {
+    return (valid[row / 64] >> (row % 64)) & 1;
+}
+
+// Validate n rows.
+//
+// air_uom holds 'F' or 'C'. Writes the InputError of each row to
+// error, and sets bit i of valid (bitmap_words(n) words) when row i
+// has no error.
+void validate_columns(std::size_t n,
+                      const double* air_temp,
+                      const double* dew_temp,
+                      const double* relative_humidity,
+                      const char* air_uom,
+                      const std::uint8_t* is_rh_set,
+                      const std::uint8_t* is_dp_set,
+                      std::uint8_t* error,
+                      std::uint64_t* valid);
+
+// Calculate the heat index (deg F) of n rows without branching on
+// their units or humidity source. relative_humidity is read and,
+// for rows with a dewpoint, overwritten with the humidity used.
+void heat_index_kernel(std::size_t n,
+                       const double* air_temp,
+                       const double* dew_temp,
+                       const char* air_uom,
+                       const std::uint8_t* is_dp_set,
+                       double* relative_humidity,
+                       double* heat_index);
+
+// Validate n rows and calculate the heat index (deg F) of every
+// row without branching on the result; invalid rows get NaN.
+// relative_humidity is read and, for rows with a dewpoint,
+// overwritten with the humidity used by the calculation.
+void calculate_columns(std::size_t n,
+                       const double* air_temp,
+                       const double* dew_temp,
+                       double* relative_humidity,
+                       const char* air_uom,
+                       const std::uint8_t* is_rh_set,
+                       const std::uint8_t* is_dp_set,
+                       std::uint8_t* error,
+                       std::uint64_t* valid,
+                       double* heat_index);
@@ -22,6 +22,12 @@
 #include "calc.h"
 #include "cgi.h"
 #include "util.h"
+#ifdef HAVE_SHM
+#include "shm.h"
+#endif
+#ifdef HAVE_FORK
+#include "shard.h"
+#endif
 
 #include <cstring>
 #include <cstdlib>
@@ -29,6 +35,11 @@
 #include <map>
 #include <string>
 
+#ifdef HAVE_SHM
+#include <atomic>
+#include <csignal>
+#endif
+
 #include <nlohmann/json.hpp>
 
 using std::string;
@@ -40,6 +51,12 @@ string version() {
 
 static void usage(const char* name) {
   std::cerr << "Usage: " << name << " [-h|--help] [-v] "
+#ifdef HAVE_SHM
+            << " [--shm NAME]"
+#endif
+#ifdef HAVE_FORK
+            << " [--shards N INPUT OUTPUT]"
+#endif
 #ifdef HAVE_SETENV
             << " [QUERY_STRING=value]\n";
 #else
@@ -52,6 +69,15 @@ static void help(const char* name) {
     std::cerr << "Options:\n"
         << "  -h or --help         Show this text and exit\n"
         << "  -v or --version      Show program version and exit\n"
+#ifdef HAVE_SHM
+        << "  --shm NAME           Serve observations from the shared memory segment NAME\n"
+#endif
+#ifdef HAVE_FORK
+        << "  --shards N INPUT OUTPUT\n"
+        << "                       Process INPUT, one query string per line, with N\n"
+        << "                       worker processes (at most one per core) and write\n"
+        << "                       the responses to OUTPUT\n"
+#endif
 #ifdef HAVE_SETENV
         << "  QUERY_STRING=value   Set the QUERY_STRING in GET request mode.\n\n";
 #else
@@ -60,6 +86,30 @@ static void help(const char* name) {
     exit(0);
 }
 
+#ifdef HAVE_SHM
+static std::atomic<bool> stop_requested(false);
+
+static void request_stop(int) {
+    stop_requested = true;
+}
+
+// Create the shared memory segment and serve co-located
+// producers until interrupted.
+static int serve_shm(const char* name) {
+    shm_channel channel;
+    if (!channel.create(name, 4096)) {
+        std::cerr << "Unable to create shared memory segment " << name << '\n';
+        return -1;
+    }
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+    run_consumer(channel, stop_requested);
+    channel.close();
+    shm_channel::unlink(name);
+    return 0;
+}
+#endif
+
 // process command line arguments,
 // faking a CGI request, if needed.
 void process_args(int argc, char** argv) {
@@ -69,6 +119,19 @@ void process_args(int argc, char** argv) {
         } else if (!std::strcmp(argv[i], "-v") || !std::strcmp(argv[i], "--version")) {
             std::cout << version() << '\n';
             exit(0);
+#ifdef HAVE_SHM
+        } else if (!std::strcmp(argv[i], "--shm") && i + 1 < argc) {
+            exit(serve_shm(argv[i+1]));
+#endif
+#ifdef HAVE_FORK
+        } else if (!std::strcmp(argv[i], "--shards") && i + 3 < argc) {
+            auto workers = std::atoi(argv[i+1]);
+            if (workers < 1) {
+                std::cerr << "The number of shards must be at least 1\n";
+                exit(-1);
+            }
+            exit(run_sharded(argv[i+2], argv[i+3], std::size_t(workers)));
+#endif
 #ifdef HAVE_SETENV
         } else if (std::strncmp(argv[i], "QUERY_STRING", 12) == 0) {
             // for testing, allow setting query string on the command line
@@ -0,0 +1,295 @@
+#ifdef HAVE_FORK
+
+#include "shard.h"
+#include "batch.h"
+#include "calc.h"
+#include "cgi.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+using std::size_t;
+using std::string;
+
+// responses calculated together by calculate_batch()
+constexpr size_t batch_size = 4096;
+
+// times a shard is attempted before the run gives up
+constexpr int max_attempts = 3;
+
+std::vector<shard_t> split_shards(const char* data, size_t size, size_t n) {
+    std::vector<shard_t> shards;
+    if (n == 0) n = 1;
+    size_t begin = 0;
+    for (size_t i = 0; i < n; ++i) {
+        size_t end = (i + 1 == n) ? size : size / n * (i + 1);
+        if (end < begin) end = begin;
+        // move the boundary to just past the end of the line
+        while (end < size && end > 0 && data[end - 1] != '\n') ++end;
+        shard_t s;
+        s.index = i;
+        s.begin = begin;
+        s.end = end;
+        shards.push_back(s);
+        begin = end;
+    }
+    return shards;
+}
+
+static response_t read_record(const string& line) {
+    if (line.empty()) {
+        response_t r {false, {"status","error"}};
+        r.doc["message"] = "Empty record.";
+        return r;
+    }
+    cgi in;
+    if (in.parse_query_string(line) == 0) {
+        response_t r {false, {"status","error"}};
+        r.doc["message"] = "Malformed record.";
+        r.doc["actual"] = line;
+        return r;
+    }
+    if (!key_provided("air_temp", in.kvp)) {
+        response_t r {false, {"status","error"}};
+        r.doc["message"] = "Required input parameter not specified.";
+        r.doc["expected"] = "air_temp";
+        r.doc["actual"] = nullptr;
+        return r;
+    }
+    return validate(in.kvp);
+}
+
+// Write the response to each row, serializing each
+// distinct response only once.
+static void write_batch(std::ofstream& out, std::vector<response_t>& batch,
+                        batch_stats_t* stats) {
+    batch_stats_t s;
+    auto result = calculate_batch(std::move(batch), &s);
+    batch.clear();
+
+    std::vector<string> text;
+    text.reserve(result.responses.size());
+    for (const auto& r: result.responses) {
+        text.push_back(r.doc.dump());
+    }
+    for (auto i: result.row) {
+        out << text[i] << '\n';
+    }
+    if (stats != nullptr) {
+        stats->rows += s.rows;
+        stats->valid += s.valid;
+        stats->unique += s.unique;
+    }
+}
+
+bool process_shard(const char* data, const shard_t& shard,
+                   const string& path, batch_stats_t* stats) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    std::vector<response_t> batch;
+    batch.reserve(batch_size);
+    size_t pos = shard.begin;
+    while (pos < shard.end) {
+        size_t eol = pos;
+        while (eol < shard.end && data[eol] != '\n') ++eol;
+        string line(data + pos, eol - pos);
+        pos = eol + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        batch.push_back(read_record(line));
+        if (batch.size() == batch_size) {
+            write_batch(out, batch, stats);
+            batch.reserve(batch_size);
+        }
+    }
+    write_batch(out, batch, stats);
+    out.close();
+    return bool(out);
+}
+
+string shard_path(const string& output, const struct stat& input,
+                  const shard_t& shard, size_t count) {
+    return output + ".shard-" + std::to_string(shard.index + 1)
+        + "-of-" + std::to_string(count)
+        + "." + std::to_string(input.st_size)
+        + "-" + std::to_string(input.st_mtim.tv_sec)
+        + "." + std::to_string(input.st_mtim.tv_nsec)
+        + "-" + std::to_string(input.st_ino)
+        + "-" + std::to_string(shard.begin)
+        + "-" + std::to_string(shard.end);
+}
+
+size_t max_workers() {
+    auto cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? size_t(cores) : 1;
+}
+
+// Remove the shard files of output that are not in keep,
+// left behind by a failed run over different input.
+static void remove_stale_shards(const string& output, const std::vector<string>& keep) {
+    auto slash = output.rfind('/');
+    string dir = slash == string::npos ? "." : output.substr(0, slash + 1);
+    string prefix = (slash == string::npos ? output : output.substr(slash + 1)) + ".shard-";
+
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) return;
+    while (auto entry = readdir(d)) {
+        string name = entry->d_name;
+        if (name.compare(0, prefix.size(), prefix) != 0) continue;
+        auto path = slash == string::npos ? name : dir + name;
+        bool current = false;
+        for (const auto& k: keep) current = current || k == path;
+        if (!current) std::remove(path.c_str());
+    }
+    closedir(d);
+}
+
+static bool file_exists(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+// Runs in the forked child and never returns
+static void run_worker(const char* data, const shard_t& shard, const string& path) {
+    // validate() reports progress on stdout; keep it out of the parent's output
+    if (std::freopen("/dev/null", "w", stdout) == nullptr) _exit(1);
+
+    batch_stats_t stats;
+    auto tmp = path + ".tmp";
+    bool ok = process_shard(data, shard, tmp, &stats)
+        && std::rename(tmp.c_str(), path.c_str()) == 0;
+    if (ok) {
+        // a single write, so reports from concurrent workers do not interleave
+        auto report = "shard " + std::to_string(shard.index + 1) + ": "
+            + make_json_stats(stats).dump() + '\n';
+        std::cerr << report;
+    }
+    std::cerr.flush();
+    _exit(ok ? 0 : 1);
+}
+
+static bool merge_shards(const std::vector<string>& paths, const string& output) {
+    auto tmp = output + ".tmp";
+    bool ok = true;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        for (const auto& path: paths) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) {
+                ok = false;
+                break;
+            }
+            if (in.peek() != std::ifstream::traits_type::eof()) out << in.rdbuf();
+        }
+        out.close();
+        ok = ok && out;
+    }
+    if (!ok || std::rename(tmp.c_str(), output.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    for (const auto& path: paths) std::remove(path.c_str());
+    return true;
+}
+
+int run_sharded(const string& input, const string& output, size_t workers, size_t limit) {
+    int fd = open(input.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Unable to open " << input << '\n';
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        std::cerr << "Unable to read " << input << '\n';
+        return -1;
+    }
+    size_t size = size_t(st.st_size);
+    const char* data = "";
+    void* addr = MAP_FAILED;
+    if (size > 0) {
+        addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            std::cerr << "Unable to map " << input << '\n';
+            return -1;
+        }
+        data = static_cast<const char*>(addr);
+    }
+    close(fd);
+
+    if (workers > limit) workers = limit;
+    auto shards = split_shards(data, size, workers);
+    std::vector<string> paths;
+    for (const auto& shard: shards) {
+        paths.push_back(shard_path(output, st, shard, shards.size()));
+    }
+    remove_stale_shards(output, paths);
+
+    // flush before forking so buffered output is not written twice
+    std::cout.flush();
+    std::cerr.flush();
+
+    std::vector<size_t> pending;
+    for (int attempt = 0; attempt < max_attempts; ++attempt) {
+        pending.clear();
+        for (size_t i = 0; i < shards.size(); ++i) {
+            if (!file_exists(paths[i])) pending.push_back(i);
+        }
+        if (pending.empty()) break;
+
+        std::vector<pid_t> pids;
+        for (auto i: pending) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                run_worker(data, shards[i], paths[i]);
+            }
+            if (pid < 0) {
+                std::cerr << "Unable to start worker for shard " << i + 1 << '\n';
+            }
+            pids.push_back(pid);
+        }
+        for (size_t n = 0; n < pids.size(); ++n) {
+            if (pids[n] < 0) continue;
+            int status = 0;
+            waitpid(pids[n], &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cerr << "Worker for shard " << pending[n] + 1 << " failed";
+                if (WIFSIGNALED(status)) std::cerr << " (signal " << WTERMSIG(status) << ')';
+                std::cerr << '\n';
+            }
+        }
+    }
+
+    if (addr != MAP_FAILED) munmap(addr, size);
+
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (!file_exists(paths[i])) {
+            std::cerr << "Shard " << i + 1 << " did not complete after "
+                      << max_attempts << " attempts; rerun to resume.\n";
+            return -1;
+        }
+    }
+    if (!merge_shards(paths, output)) {
+        std::cerr << "Unable to write " << output << '\n';
+        return -1;
+    }
+    return 0;
+}
+
+#endif // HAVE_FORK
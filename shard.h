@@ -0,0 +1,53 @@
+#pragma once
+
+#include "batch.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+// Archive reprocessing across several worker processes.
+//
+// The input holds one query string per line, e.g.
+//   air_temp=90&relative_humidity=55
+// and the output holds the json response for each line, one
+// per line, in the same order. Blank lines get an error response.
+
+// A byte range of the input holding whole lines
+struct shard_t {
+    std::size_t index = 0;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+};
+
+// Split size bytes of data into n ranges, each starting
+// at the beginning of a line.
+std::vector<shard_t> split_shards(const char* data, std::size_t size, std::size_t n);
+
+// Parse, validate and calculate every line of a shard,
+// writing the responses to path.
+bool process_shard(const char* data, const shard_t& shard,
+                   const std::string& path, batch_stats_t* stats = nullptr);
+
+// The file holding a finished shard of input. Its name records the
+// input's size, modification time and inode and the shard's byte
+// range, so a shard cut from different input is never reused.
+std::string shard_path(const std::string& output, const struct stat& input,
+                       const shard_t& shard, std::size_t count);
+
+// The most workers run_sharded() starts: the number of online cores
+std::size_t max_workers();
+
+// Process input with one forked worker per shard and merge the
+// results into output. Each shard is written to its own file next
+// to the output, and only renamed into place once complete, so a
+// shard whose worker died is simply run again. Finished shards
+// are kept if the run fails, and a later run over the same input
+// with the same number of workers picks up where it left off;
+// shard files left by any other run are removed.
+//
+// workers is capped at limit. Returns 0 on success.
+int run_sharded(const std::string& input, const std::string& output,
+                std::size_t workers, std::size_t limit = max_workers());
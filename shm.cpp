@@ -0,0 +1,198 @@
+#ifdef HAVE_SHM
+
+#include "shm.h"
+#include "calc.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::size_t;
+using std::uint64_t;
+
+// The ring indices and magic are shared between processes, which is
+// only sound if their atomics are lock-free (and so address-free).
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "shared memory rings need lock-free 32 and 64 bit atomics");
+
+constexpr std::uint32_t shm_magic = 0x48454154;  // "HEAT"
+constexpr std::uint32_t shm_version = 1;
+
+static size_t segment_size(size_t capacity) {
+    return sizeof(shm_header_t)
+        + capacity * sizeof(observation_t)
+        + capacity * sizeof(observation_result_t);
+}
+
+// let a spinning core back off without leaving user space
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+shm_channel::~shm_channel() {
+    close();
+}
+
+bool shm_channel::map(int fd, size_t bytes) {
+    auto addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) return false;
+    length = bytes;
+    header = static_cast<shm_header_t*>(addr);
+    return true;
+}
+
+bool shm_channel::create(const std::string& name, size_t capacity) {
+    close();
+    if (capacity == 0) return false;
+    size_t slots = 1;
+    while (slots < capacity) slots <<= 1;
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) return false;
+    auto bytes = segment_size(slots);
+    if (ftruncate(fd, off_t(bytes)) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    if (!map(fd, bytes)) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    new (&header->magic) std::atomic<std::uint32_t>(0);
+    header->capacity = slots;
+    new (&header->in.head) std::atomic<uint64_t>(0);
+    new (&header->in.tail) std::atomic<uint64_t>(0);
+    new (&header->out.head) std::atomic<uint64_t>(0);
+    new (&header->out.tail) std::atomic<uint64_t>(0);
+    header->version = shm_version;
+    // publish the header last so attach() never sees a half built segment
+    header->magic.store(shm_magic, std::memory_order_release);
+
+    observations = reinterpret_cast<observation_t*>(header + 1);
+    results = reinterpret_cast<observation_result_t*>(observations + slots);
+    return true;
+}
+
+bool shm_channel::attach(const std::string& name) {
+    close();
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(shm_header_t)) {
+        ::close(fd);
+        return false;
+    }
+    if (!map(fd, size_t(st.st_size))) return false;
+
+    // pairs with the release in create(); read before version and capacity
+    if (header->magic.load(std::memory_order_acquire) != shm_magic
+        || header->version != shm_version
+        || segment_size(size_t(header->capacity)) > length) {
+        close();
+        return false;
+    }
+    observations = reinterpret_cast<observation_t*>(header + 1);
+    results = reinterpret_cast<observation_result_t*>(observations + header->capacity);
+    return true;
+}
+
+void shm_channel::close() {
+    if (header != nullptr) {
+        munmap(header, length);
+    }
+    header = nullptr;
+    observations = nullptr;
+    results = nullptr;
+    length = 0;
+}
+
+bool shm_channel::unlink(const std::string& name) {
+    return shm_unlink(name.c_str()) == 0;
+}
+
+bool shm_channel::push(const observation_t& obs) {
+    auto head = header->in.head.load(std::memory_order_relaxed);
+    auto tail = header->in.tail.load(std::memory_order_acquire);
+    if (head - tail == header->capacity) return false;
+    observations[head & (header->capacity - 1)] = obs;
+    header->in.head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+bool shm_channel::pop(observation_result_t& result) {
+    auto tail = header->out.tail.load(std::memory_order_relaxed);
+    auto head = header->out.head.load(std::memory_order_acquire);
+    if (head == tail) return false;
+    result = results[tail & (header->capacity - 1)];
+    header->out.tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+static observation_result_t process_observation(const observation_t& obs) {
+    observation_result_t r;
+    r.id = obs.id;
+
+    input_data_t input;
+    input.air_temp = obs.air_temp;
+    input.air_uom = obs.air_uom;
+    input.dew_temp = obs.dew_temp;
+    input.relative_humidity = obs.relative_humidity;
+    input.is_rh_set = (obs.flags & obs_rh_set) != 0;
+    input.is_dp_set = (obs.flags & obs_dp_set) != 0;
+
+    auto error = check_input(input);
+    r.error = std::int32_t(error);
+    if (error == InputError::none) {
+        r.heat_index = compute_heat_index(input);
+        r.relative_humidity = input.relative_humidity;
+    }
+    return r;
+}
+
+size_t shm_channel::process(size_t max_records) {
+    auto mask = header->capacity - 1;
+    auto in_tail = header->in.tail.load(std::memory_order_relaxed);
+    auto in_head = header->in.head.load(std::memory_order_acquire);
+    auto out_head = header->out.head.load(std::memory_order_relaxed);
+    auto out_tail = header->out.tail.load(std::memory_order_acquire);
+
+    // only take what the result ring has room for
+    uint64_t count = in_head - in_tail;
+    uint64_t room = header->capacity - (out_head - out_tail);
+    if (count > room) count = room;
+    if (count > max_records) count = max_records;
+
+    for (uint64_t i = 0; i < count; ++i) {
+        results[(out_head + i) & mask] = process_observation(observations[(in_tail + i) & mask]);
+    }
+    if (count > 0) {
+        header->out.head.store(out_head + count, std::memory_order_release);
+        header->in.tail.store(in_tail + count, std::memory_order_release);
+    }
+    return size_t(count);
+}
+
+void run_consumer(shm_channel& channel, const std::atomic<bool>& stop) {
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (channel.process() == 0) {
+            cpu_relax();
+        }
+    }
+}
+
+#endif // HAVE_SHM
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Shared memory ingestion for producers running on the same host.
+//
+// A POSIX shared memory segment holds two single producer /
+// single consumer rings: observations flow in, results flow out.
+// Both ends only touch the ring indices and the fixed layout
+// records below, so the steady state makes no system calls.
+
+// observation flags
+constexpr std::uint8_t obs_rh_set = 0x1;
+constexpr std::uint8_t obs_dp_set = 0x2;
+
+// A single reading, laid out the same for every process
+struct observation_t {
+    std::uint64_t id = 0;              // chosen by the producer
+    double air_temp = -273.0;
+    double dew_temp = -273.0;
+    double relative_humidity = 0.0;
+    char air_uom = 'F';                // 'F' or 'C'
+    std::uint8_t flags = 0;            // obs_rh_set and/or obs_dp_set
+    std::uint8_t reserved[6] = {};
+};
+
+// The answer to a single observation
+struct observation_result_t {
+    std::uint64_t id = 0;              // copied from the observation
+    double heat_index = 0.0;           // deg F, only set if error == 0
+    double relative_humidity = 0.0;    // as used by the calculation (%)
+    std::int32_t error = 0;            // an InputError value
+    std::int32_t reserved = 0;
+};
+
+// Read and write positions of one ring.
+// Each index is on its own cache line to avoid false sharing.
+struct ring_index_t {
+    alignas(64) std::atomic<std::uint64_t> head;  // next slot to write
+    alignas(64) std::atomic<std::uint64_t> tail;  // next slot to read
+};
+
+// Start of the shared memory segment.
+// The observation slots and then the result slots follow it.
+struct shm_header_t {
+    std::atomic<std::uint32_t> magic;  // set last, once the rest is ready
+    std::uint32_t version;
+    std::uint64_t capacity;            // slots per ring, a power of 2
+    ring_index_t in;                   // observations
+    ring_index_t out;                  // results
+};
+
+class shm_channel {
+public:
+    shm_channel() = default;
+    ~shm_channel();
+    shm_channel(const shm_channel&) = delete;
+    shm_channel& operator=(const shm_channel&) = delete;
+
+    // Create a new segment, rounding capacity up to a power of 2.
+    // An existing segment of the same name is replaced.
+    bool create(const std::string& name, std::size_t capacity);
+    // Map a segment created by another process
+    bool attach(const std::string& name);
+    // Unmap the segment; it stays available to other processes
+    void close();
+    // Remove the segment name from the system
+    static bool unlink(const std::string& name);
+
+    bool is_open() const { return header != nullptr; }
+    std::size_t capacity() const {
+        return header == nullptr ? 0 : std::size_t(header->capacity);
+    }
+
+    // Producer side: false if the observation ring is full
+    bool push(const observation_t& obs);
+    // Producer side: false if no result is waiting
+    bool pop(observation_result_t& result);
+
+    // Consumer side: validate and calculate up to max_records
+    // waiting observations, returning the number processed.
+    std::size_t process(std::size_t max_records = 256);
+
+private:
+    shm_header_t* header = nullptr;
+    observation_t* observations = nullptr;
+    observation_result_t* results = nullptr;
+    std::size_t length = 0;
+
+    bool map(int fd, std::size_t bytes);
+};
+
+// Run the consumer side of a channel until stop is set
+void run_consumer(shm_channel& channel, const std::atomic<bool>& stop);
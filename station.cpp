@@ -0,0 +1,141 @@
+#include "station.h"
+#include "calc.h"
+#include "columns.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::size_t;
+using std::uint8_t;
+
+station_table::station_table()
+    : front{std::make_shared<station_columns_t>()}, published{front}
+{}
+
+void station_table::update(const std::string& station_id, const input_data_t& input) {
+    std::lock_guard<std::mutex> lock(writer);
+    size_t row;
+    auto it = index.find(station_id);
+    if (it == index.end()) {
+        row = rows.size();
+        index.emplace(station_id, row);
+        rows.id.push_back(station_id);
+        rows.air_temp.push_back(0.0);
+        rows.dew_temp.push_back(0.0);
+        rows.relative_humidity.push_back(0.0);
+        rows.heat_index.push_back(std::numeric_limits<double>::quiet_NaN());
+        rows.air_uom.push_back('F');
+        rows.is_dp_set.push_back(0);
+        rows.error.push_back(0);
+        is_dirty.push_back(0);
+    } else {
+        row = it->second;
+    }
+
+    rows.air_temp[row] = input.air_temp;
+    rows.dew_temp[row] = input.dew_temp;
+    rows.relative_humidity[row] = input.relative_humidity;
+    rows.air_uom[row] = input.air_uom.empty() ? '?' : input.air_uom[0];
+    rows.is_dp_set[row] = input.is_dp_set;
+    rows.error[row] = uint8_t(check_input(input));
+    if (!is_dirty[row]) {
+        is_dirty[row] = 1;
+        dirty.push_back(row);
+    }
+}
+
+size_t station_table::recompute() {
+    std::lock_guard<std::mutex> lock(writer);
+    auto n = dirty.size();
+
+    // gather the dirty rows so the kernel runs over contiguous memory
+    std::vector<double> air_temp(n), dew_temp(n), rh(n), heat_index(n);
+    std::vector<char> air_uom(n);
+    std::vector<uint8_t> is_dp_set(n);
+    for (size_t i = 0; i < n; ++i) {
+        auto row = dirty[i];
+        air_temp[i] = rows.air_temp[row];
+        dew_temp[i] = rows.dew_temp[row];
+        rh[i] = rows.relative_humidity[row];
+        air_uom[i] = rows.air_uom[row];
+        is_dp_set[i] = rows.is_dp_set[row];
+    }
+
+    heat_index_kernel(n, air_temp.data(), dew_temp.data(),
+                      air_uom.data(), is_dp_set.data(),
+                      rh.data(), heat_index.data());
+
+    const auto invalid = std::numeric_limits<double>::quiet_NaN();
+    for (size_t i = 0; i < n; ++i) {
+        auto row = dirty[i];
+        auto ok = rows.error[row] == uint8_t(InputError::none);
+        rows.relative_humidity[row] = rh[i];
+        rows.heat_index[row] = ok ? heat_index[i] : invalid;
+        is_dirty[row] = 0;
+    }
+
+    // Reuse the previous snapshot if no reader holds it any more.
+    // It is no longer published, so nobody can take a new reference
+    // and a count of one stays one. use_count() is a relaxed load,
+    // so the fence orders the last reader's release of it before
+    // we write to the buffer.
+    std::shared_ptr<station_columns_t> next;
+    if (back && back.use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        next = std::move(back);
+        patch(*next, back_stale);
+        patch(*next, dirty);
+    } else {
+        next = std::make_shared<station_columns_t>(rows);
+    }
+    back = std::move(front);
+    front = std::move(next);
+    std::atomic_store(&published, std::shared_ptr<const station_columns_t>(front));
+
+    back_stale.swap(dirty);
+    dirty.clear();
+    return n;
+}
+
+void station_table::patch(station_columns_t& buffer, const std::vector<size_t>& changed) const {
+    // stations added since the buffer was published
+    for (auto row = buffer.size(); row < rows.size(); ++row) {
+        buffer.id.push_back(rows.id[row]);
+        buffer.air_temp.push_back(rows.air_temp[row]);
+        buffer.dew_temp.push_back(rows.dew_temp[row]);
+        buffer.relative_humidity.push_back(rows.relative_humidity[row]);
+        buffer.heat_index.push_back(rows.heat_index[row]);
+        buffer.air_uom.push_back(rows.air_uom[row]);
+        buffer.is_dp_set.push_back(rows.is_dp_set[row]);
+        buffer.error.push_back(rows.error[row]);
+    }
+    for (auto row: changed) {
+        buffer.air_temp[row] = rows.air_temp[row];
+        buffer.dew_temp[row] = rows.dew_temp[row];
+        buffer.relative_humidity[row] = rows.relative_humidity[row];
+        buffer.heat_index[row] = rows.heat_index[row];
+        buffer.air_uom[row] = rows.air_uom[row];
+        buffer.is_dp_set[row] = rows.is_dp_set[row];
+        buffer.error[row] = rows.error[row];
+    }
+}
+
+std::shared_ptr<const station_columns_t> station_table::snapshot() const {
+    return std::atomic_load(&published);
+}
+
+size_t station_table::size() const {
+    std::lock_guard<std::mutex> lock(writer);
+    return rows.size();
+}
+
+size_t station_table::dirty_count() const {
+    std::lock_guard<std::mutex> lock(writer);
+    return dirty.size();
+}
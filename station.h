@@ -0,0 +1,71 @@
+#pragma once
+
+#include "calc.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The latest inputs and heat index of every station,
+// one vector per field, indexed by row.
+struct station_columns_t {
+    std::vector<std::string> id;
+    std::vector<double> air_temp;
+    std::vector<double> dew_temp;
+    std::vector<double> relative_humidity;   // as used by the calculation (%)
+    std::vector<double> heat_index;          // deg F, NaN if the input is invalid
+    std::vector<char> air_uom;               // 'F' or 'C', for air and dewpoint
+    std::vector<std::uint8_t> is_dp_set;     // humidity comes from the dewpoint
+    std::vector<std::uint8_t> error;         // an InputError value
+
+    std::size_t size() const { return id.size(); }
+};
+
+// Heat index for a large set of stations where only a few
+// report between refreshes.
+//
+// update() stores a reading and marks its row dirty;
+// recompute() calculates only the dirty rows and publishes
+// a new snapshot. Readers take a snapshot without waiting on
+// writers and see the table as of the last recompute().
+//
+// Snapshots are double buffered: the snapshot published before
+// the current one is brought up to date by copying only the rows
+// changed since, as long as no reader still holds it.
+class station_table {
+public:
+    station_table();
+
+    // Store the latest reading for a station and mark it for recompute
+    void update(const std::string& station_id, const input_data_t& input);
+
+    // Calculate every dirty row and publish a new snapshot.
+    // Returns the number of rows calculated.
+    std::size_t recompute();
+
+    // The table as of the last recompute()
+    std::shared_ptr<const station_columns_t> snapshot() const;
+
+    std::size_t size() const;
+    std::size_t dirty_count() const;
+
+private:
+    mutable std::mutex writer;
+    station_columns_t rows;
+    std::unordered_map<std::string, std::size_t> index;
+    std::vector<std::size_t> dirty;
+    std::vector<std::uint8_t> is_dirty;
+
+    // the current snapshot, and the one before it
+    std::shared_ptr<station_columns_t> front;
+    std::shared_ptr<station_columns_t> back;
+    // rows calculated by the last recompute(), missing from back
+    std::vector<std::size_t> back_stale;
+    std::shared_ptr<const station_columns_t> published;
+
+    void patch(station_columns_t& buffer, const std::vector<std::size_t>& changed) const;
+};
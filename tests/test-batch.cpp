@@ -0,0 +1,57 @@
+#undef DOCTEST_CONFIG_POSIX_SIGNALS
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../batch.h"
+#include "../calc.h"
+#include <doctest.h>
+#include <nlohmann/json.hpp>
+
+#include <vector>
+using nlohmann::json;
+
+static response_t make_rh(double air_temp, double rh) {
+    response_t r = {true, {"status","success"}};
+    r.input.air_temp = air_temp;
+    r.input.relative_humidity = rh;
+    r.input.is_rh_set = true;
+    return r;
+}
+
+SCENARIO( "Calculate a batch with repeated inputs" ) {
+    std::vector<response_t> batch;
+    batch.push_back(make_rh(90, 50));
+    batch.push_back(make_rh(95, 60));
+    batch.push_back(make_rh(90, 50));
+    batch.push_back(response_t{false, {"status","error"}});
+    batch.push_back(make_rh(90, 50));
+
+    batch_stats_t stats;
+    auto actual = calculate_batch(batch, &stats);
+
+    WHEN ("The batch is calculated") {
+	THEN ("each unique input is calculated once") {
+	    REQUIRE(stats.rows == 5);
+	    REQUIRE(stats.valid == 4);
+	    REQUIRE(stats.unique == 2);
+	    REQUIRE(stats.dedup_ratio() == doctest::Approx(2.0));
+	}
+	AND_THEN ("results keep the original row order") {
+	    REQUIRE(actual.size() == batch.size());
+	    for (std::size_t i = 0; i < batch.size(); ++i) {
+		if (batch[i].valid) {
+		    REQUIRE(actual[i].doc == calculate(batch[i]).doc);
+		}
+	    }
+	}
+	AND_THEN ("duplicate rows share one response") {
+	    REQUIRE(actual.responses.size() == 3);
+	    REQUIRE(actual.row[0] == actual.row[2]);
+	    REQUIRE(actual.row[0] == actual.row[4]);
+	    REQUIRE(actual.row[0] != actual.row[1]);
+	}
+	AND_THEN ("invalid responses are passed through") {
+	    REQUIRE(actual[3].valid == false);
+	    REQUIRE(actual[3].doc == batch[3].doc);
+	}
+    }
+}
@@ -0,0 +1,98 @@
+#undef DOCTEST_CONFIG_POSIX_SIGNALS
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../calc.h"
+#include "../columns.h"
+#include <doctest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+SCENARIO( "Validate inputs stored by column" ) {
+    std::vector<double> air_temp, dew_temp, rh;
+    std::vector<char> uom;
+    std::vector<std::uint8_t> rh_set, dp_set;
+
+    // every combination of units, humidity source and range
+    const char uoms[] = {'F', 'C', 'K'};
+    const double temps[] = {10, 27, 50, 79, 85, 100, 150, 250};
+    const double humidities[] = {-5, 20, 40, 45, 70, 100, 101, std::nan("")};
+    for (auto u: uoms) {
+	for (auto t: temps) {
+	    for (auto h: humidities) {
+		for (int flags = 0; flags < 4; ++flags) {
+		    air_temp.push_back(t);
+		    dew_temp.push_back(t - h / 2);
+		    rh.push_back(h);
+		    uom.push_back(u);
+		    rh_set.push_back(flags & 1);
+		    dp_set.push_back((flags >> 1) & 1);
+		}
+	    }
+	}
+    }
+    auto n = air_temp.size();
+    std::vector<std::uint8_t> error(n);
+    std::vector<std::uint64_t> valid(bitmap_words(n));
+    std::vector<double> heat_index(n);
+    auto rh_used = rh;
+    calculate_columns(n, air_temp.data(), dew_temp.data(), rh_used.data(), uom.data(),
+		      rh_set.data(), dp_set.data(), error.data(), valid.data(),
+		      heat_index.data());
+
+    WHEN ("A batch is validated") {
+	THEN ("every row matches check_input") {
+	    for (std::size_t i = 0; i < n; ++i) {
+		input_data_t in;
+		in.air_temp = air_temp[i];
+		in.dew_temp = dew_temp[i];
+		in.relative_humidity = rh[i];
+		in.air_uom = uom[i];
+		in.is_rh_set = rh_set[i] != 0;
+		in.is_dp_set = dp_set[i] != 0;
+		auto expected = check_input(in);
+		REQUIRE(error[i] == std::uint8_t(expected));
+		REQUIRE(row_valid(valid.data(), i) == (expected == InputError::none));
+		if (expected == InputError::none) {
+		    REQUIRE(heat_index[i] == doctest::Approx(compute_heat_index(in)));
+		} else {
+		    REQUIRE(std::isnan(heat_index[i]));
+		}
+	    }
+	}
+    }
+}
+
+SCENARIO( "Ignore the unused humidity column" ) {
+    // the column that is not set is left as NaN, as columnar feeds do
+    const double air_temp[] = {90, 90};
+    const double dew_temp[] = {std::nan(""), 85};
+    double rh[] = {50, std::nan("")};
+    const char uom[] = {'F', 'F'};
+    const std::uint8_t rh_set[] = {1, 0};
+    const std::uint8_t dp_set[] = {0, 1};
+    std::uint8_t error[2];
+    std::uint64_t valid[1];
+    double heat_index[2];
+    calculate_columns(2, air_temp, dew_temp, rh, uom, rh_set, dp_set,
+		      error, valid, heat_index);
+
+    WHEN ("Each row is valid") {
+	input_data_t by_rh;
+	by_rh.air_temp = 90;
+	by_rh.relative_humidity = 50;
+	by_rh.is_rh_set = true;
+	input_data_t by_dp;
+	by_dp.air_temp = 90;
+	by_dp.dew_temp = 85;
+	by_dp.is_dp_set = true;
+	THEN ("the heat index matches compute_heat_index") {
+	    REQUIRE(error[0] == 0);
+	    REQUIRE(error[1] == 0);
+	    REQUIRE(valid[0] == 3);
+	    REQUIRE(heat_index[0] == doctest::Approx(compute_heat_index(by_rh)));
+	    REQUIRE(heat_index[1] == doctest::Approx(compute_heat_index(by_dp)));
+	}
+    }
+}
@@ -0,0 +1,151 @@
+#undef DOCTEST_CONFIG_POSIX_SIGNALS
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../shard.h"
+#include <doctest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+using std::string;
+
+static void write_file(const string& path, const string& text) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << text;
+}
+
+static string read_file(const string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+static std::size_t count_lines(const string& text) {
+    return std::size_t(std::count(text.begin(), text.end(), '\n'));
+}
+
+static bool exists(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+// every shard starts at a line and together they cover the input
+static bool well_formed(const string& data, const std::vector<shard_t>& shards) {
+    std::size_t pos = 0;
+    for (const auto& s: shards) {
+	if (s.begin != pos || s.end < s.begin) return false;
+	if (s.begin > 0 && s.begin < data.size() && data[s.begin - 1] != '\n') return false;
+	pos = s.end;
+    }
+    return pos == data.size();
+}
+
+SCENARIO( "Split an archive into shards" ) {
+    WHEN ("Lines are longer than the shards") {
+	string data = "air_temp=90&relative_humidity=50\nair_temp=91&relative_humidity=51\n";
+	auto shards = split_shards(data.data(), data.size(), 8);
+	THEN ("boundaries stay on line starts") {
+	    REQUIRE(shards.size() == 8);
+	    REQUIRE(well_formed(data, shards));
+	}
+    }
+    WHEN ("There are fewer bytes than shards") {
+	string data = "a\n";
+	auto shards = split_shards(data.data(), data.size(), 4);
+	THEN ("the extra shards are empty") {
+	    REQUIRE(well_formed(data, shards));
+	}
+    }
+    WHEN ("The last line has no newline and lines end in CRLF") {
+	string data = "x=1\r\nair_temp=90\r\nair_temp=95&dew_temp=85";
+	auto shards = split_shards(data.data(), data.size(), 3);
+	THEN ("the last shard ends at the end of the data") {
+	    REQUIRE(well_formed(data, shards));
+	    REQUIRE(shards.back().end == data.size());
+	}
+    }
+}
+
+SCENARIO( "Process a shard" ) {
+    string data = "air_temp=90&relative_humidity=50\r\n\nbogus\nair_temp=90&relative_humidity=50";
+    shard_t all;
+    all.end = data.size();
+    const string path = "test-shard-process.out";
+    batch_stats_t stats;
+    REQUIRE(process_shard(data.data(), all, path, &stats));
+    auto text = read_file(path);
+    std::remove(path.c_str());
+
+    WHEN ("Some lines are blank or malformed") {
+	THEN ("every input line gets one output line") {
+	    REQUIRE(count_lines(text) == 4);
+	    REQUIRE(stats.rows == 4);
+	}
+	AND_THEN ("duplicate lines are calculated once") {
+	    REQUIRE(stats.valid == 2);
+	    REQUIRE(stats.unique == 1);
+	}
+    }
+}
+
+SCENARIO( "Run and resume a sharded archive" ) {
+    const string input = "test-shard-input.txt";
+    const string output = "test-shard-output.txt";
+    string data;
+    for (int i = 0; i < 40; ++i) {
+	data += "air_temp=" + std::to_string(81 + i % 10) + "&relative_humidity=50\n";
+    }
+    write_file(input, data);
+    struct stat st;
+    stat(input.c_str(), &st);
+    // two shards even on a single core, so there is always one to resume
+    const std::size_t count = 2;
+    auto shards = split_shards(data.data(), data.size(), count);
+    REQUIRE(shards.size() == count);
+
+    REQUIRE(run_sharded(input, output, count, count) == 0);
+    auto clean = read_file(output);
+
+    WHEN ("A run completes") {
+	THEN ("the output has a line per input line") {
+	    REQUIRE(count_lines(clean) == 40);
+	}
+	AND_THEN ("the shard files are removed") {
+	    REQUIRE_FALSE(exists(shard_path(output, st, shards[0], count)));
+	}
+    }
+
+    WHEN ("An earlier run left a finished shard") {
+	auto done = shard_path(output, st, shards[0], count);
+	write_file(done, "reused\n");
+	REQUIRE_FALSE(exists(shard_path(output, st, shards[1], count)));
+	REQUIRE(run_sharded(input, output, count, count) == 0);
+	auto text = read_file(output);
+	THEN ("it is merged in place and only the missing shard runs") {
+	    REQUIRE(text.compare(0, 7, "reused\n") == 0);
+	    REQUIRE(count_lines(text) == 1 + count_lines(data.substr(shards[1].begin)));
+	    REQUIRE(text.substr(7) == clean.substr(clean.size() - (text.size() - 7)));
+	}
+    }
+
+    WHEN ("A failed run over other input left shards behind") {
+	shard_t other = shards[0];
+	other.end += 1;
+	auto stale = shard_path(output, st, other, count);
+	write_file(stale, "stale\n");
+	REQUIRE(run_sharded(input, output, count, count) == 0);
+	THEN ("they are discarded") {
+	    REQUIRE_FALSE(exists(stale));
+	    REQUIRE(read_file(output) == clean);
+	}
+    }
+
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+}
@@ -0,0 +1,91 @@
+#undef DOCTEST_CONFIG_POSIX_SIGNALS
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../calc.h"
+#include "../shm.h"
+#include <doctest.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+using std::string;
+
+static const string segment = "/heat-index-test-shm";
+
+// Stands in for the acquisition daemon: attaches to the
+// segment and feeds it readings, collecting the results.
+struct producer_stub {
+    shm_channel channel;
+    std::vector<observation_result_t> results;
+
+    bool attach() { return channel.attach(segment); }
+
+    void run(const std::vector<observation_t>& readings) {
+        std::size_t sent = 0;
+        while (results.size() < readings.size()) {
+            if (sent < readings.size() && channel.push(readings[sent])) {
+                ++sent;
+            }
+            observation_result_t r;
+            while (channel.pop(r)) {
+                results.push_back(r);
+            }
+        }
+    }
+};
+
+static observation_t make_rh(std::uint64_t id, double air_temp, double rh) {
+    observation_t obs;
+    obs.id = id;
+    obs.air_temp = air_temp;
+    obs.relative_humidity = rh;
+    obs.flags = obs_rh_set;
+    return obs;
+}
+
+SCENARIO( "Serve observations over shared memory" ) {
+    shm_channel consumer;
+    REQUIRE(consumer.create(segment, 6));
+    REQUIRE(consumer.capacity() == 8);
+
+    std::vector<observation_t> readings;
+    for (std::uint64_t i = 0; i < 100; ++i) {
+        readings.push_back(make_rh(i, 80.0 + double(i % 20), 40.0 + double(i % 60)));
+    }
+    readings[7].relative_humidity = 10;
+    readings[9].flags |= obs_dp_set;
+    readings[11].relative_humidity = std::nan("");
+
+    std::atomic<bool> stop(false);
+    std::thread worker([&] { run_consumer(consumer, stop); });
+
+    producer_stub producer;
+    REQUIRE(producer.attach());
+    producer.run(readings);
+    stop = true;
+    worker.join();
+    shm_channel::unlink(segment);
+
+    WHEN ("Every reading has been answered") {
+	THEN ("results come back in order") {
+	    REQUIRE(producer.results.size() == readings.size());
+	    for (std::size_t i = 0; i < readings.size(); ++i) {
+		REQUIRE(producer.results[i].id == readings[i].id);
+	    }
+	}
+	AND_THEN ("invalid readings carry their error") {
+	    REQUIRE(producer.results[7].error == int(InputError::rh_range));
+	    REQUIRE(producer.results[9].error == int(InputError::both_rh_dp));
+	    REQUIRE(producer.results[11].error == int(InputError::rh_range));
+	}
+	AND_THEN ("valid readings match calculate_heat_index") {
+	    auto& r = producer.results[42];
+	    REQUIRE(r.error == int(InputError::none));
+	    REQUIRE(r.heat_index == doctest::Approx(calculate_heat_index(readings[42].air_temp,
+									  readings[42].relative_humidity)));
+	}
+    }
+}
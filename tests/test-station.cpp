@@ -0,0 +1,119 @@
+#undef DOCTEST_CONFIG_POSIX_SIGNALS
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "../calc.h"
+#include "../station.h"
+#include <doctest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+using std::string;
+
+static input_data_t make_rh(double air_temp, double rh) {
+    input_data_t in;
+    in.air_temp = air_temp;
+    in.relative_humidity = rh;
+    in.is_rh_set = true;
+    return in;
+}
+
+static double expected_heat_index(input_data_t in) {
+    return compute_heat_index(in);
+}
+
+SCENARIO( "Recalculate only the stations that reported" ) {
+    station_table table;
+    for (int i = 0; i < 10; ++i) {
+	table.update("station-" + std::to_string(i), make_rh(85 + i, 50));
+    }
+
+    WHEN ("New stations are added") {
+	THEN ("every row is dirty") {
+	    REQUIRE(table.size() == 10);
+	    REQUIRE(table.dirty_count() == 10);
+	}
+	AND_THEN ("nothing is published before recompute") {
+	    REQUIRE(table.snapshot()->size() == 0);
+	}
+    }
+
+    WHEN ("The table is recomputed") {
+	REQUIRE(table.recompute() == 10);
+	THEN ("the dirty rows are cleared") {
+	    REQUIRE(table.dirty_count() == 0);
+	    REQUIRE(table.recompute() == 0);
+	}
+	AND_THEN ("the snapshot holds every heat index") {
+	    auto snap = table.snapshot();
+	    REQUIRE(snap->size() == 10);
+	    for (int i = 0; i < 10; ++i) {
+		REQUIRE(snap->id[i] == "station-" + std::to_string(i));
+		REQUIRE(snap->heat_index[i] == doctest::Approx(expected_heat_index(make_rh(85 + i, 50))));
+	    }
+	}
+    }
+
+    WHEN ("A few stations report again") {
+	table.recompute();
+	auto before = table.snapshot();
+	table.update("station-3", make_rh(99, 70));
+	table.update("station-3", make_rh(98, 60));
+	table.update("station-5", make_rh(10, 50));
+	REQUIRE(table.dirty_count() == 2);
+	REQUIRE(table.recompute() == 2);
+	auto after = table.snapshot();
+	THEN ("their rows are recalculated") {
+	    REQUIRE(after->heat_index[3] == doctest::Approx(expected_heat_index(make_rh(98, 60))));
+	}
+	AND_THEN ("invalid rows get NaN and their error") {
+	    REQUIRE(std::isnan(after->heat_index[5]));
+	    REQUIRE(after->error[5] == std::uint8_t(InputError::air_temp_range));
+	}
+	AND_THEN ("untouched rows keep their cached value") {
+	    REQUIRE(after->heat_index[4] == before->heat_index[4]);
+	}
+	AND_THEN ("the earlier snapshot is unchanged") {
+	    REQUIRE(before.get() != after.get());
+	    REQUIRE(before->heat_index[3] == doctest::Approx(expected_heat_index(make_rh(88, 50))));
+	    REQUIRE(before->error[5] == std::uint8_t(InputError::none));
+	}
+    }
+
+    WHEN ("A station reports humidity with no dewpoint") {
+	auto in = make_rh(90, 50);
+	in.dew_temp = std::nan("");
+	table.update("a", in);
+	table.recompute();
+	auto snap = table.snapshot();
+	THEN ("the unused dewpoint does not reach its heat index") {
+	    REQUIRE(snap->id[10] == "a");
+	    REQUIRE(snap->error[10] == std::uint8_t(InputError::none));
+	    REQUIRE(snap->heat_index[10] == doctest::Approx(expected_heat_index(make_rh(90, 50))));
+	}
+    }
+
+    WHEN ("Snapshots are reused across many refreshes") {
+	table.recompute();
+	for (int cycle = 0; cycle < 5; ++cycle) {
+	    auto station = "station-" + std::to_string(cycle * 2);
+	    table.update(station, make_rh(90 + cycle, 45 + cycle));
+	    table.update("new-" + std::to_string(cycle), make_rh(100, 40 + cycle));
+	    table.recompute();
+	}
+	THEN ("the latest snapshot matches every station's last reading") {
+	    auto snap = table.snapshot();
+	    REQUIRE(snap->size() == 15);
+	    for (int i = 0; i < 10; ++i) {
+		auto in = make_rh(85 + i, 50);
+		if (i % 2 == 0 && i / 2 < 5) in = make_rh(90 + i / 2, 45 + i / 2);
+		REQUIRE(snap->heat_index[i] == doctest::Approx(expected_heat_index(in)));
+	    }
+	    for (int cycle = 0; cycle < 5; ++cycle) {
+		REQUIRE(snap->id[10 + cycle] == "new-" + std::to_string(cycle));
+		REQUIRE(snap->heat_index[10 + cycle]
+			== doctest::Approx(expected_heat_index(make_rh(100, 40 + cycle))));
+	    }
+	}
+    }
+}